@@ -30,34 +30,66 @@ public:
         thread_ = std::thread{std::bind(&AsyncResponseHandler::Run, this)};
     }
 
+    ~AsyncResponseHandler() override {
+        Stop();
+    }
+
     void HandleResponse(const Response& response) override {
         std::lock_guard lock{mutex_};
         response_queue_.push(response);
+        ++queued_count_;
         cv_.notify_all();
     }
 
+    // Returns the number of responses queued so far, to be passed to WaitUntilHandled.
+    size_t GetQueuedCount() {
+        std::lock_guard lock{mutex_};
+        return queued_count_;
+    }
+
+    // Blocks until the first queued_count responses are handled. Responses queued later are not waited for.
+    void WaitUntilHandled(size_t queued_count) {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [this, queued_count] { return handled_count_ >= queued_count; });
+    }
+
+    // Handles all queued responses and joins the worker thread. Does nothing if it is already stopped.
     void Stop() {
         std::unique_lock lock{mutex_};
+        if (stop_) {
+            return;
+        }
         stop_ = true;
         cv_.notify_all();
         lock.unlock();
         thread_.join();
     }
 
-    bool IsStopped() {
-        return stop_;
-    }
-
 private:
+    // Besides handling responses, wakes up at the inner handler's flush deadline even if nothing is queued.
     void Run() {
         std::unique_lock lock{mutex_};
+        auto flush_deadline = std::chrono::steady_clock::time_point::max();
+        const auto has_work = [this] { return !response_queue_.empty() || stop_; };
         while (!stop_ || !response_queue_.empty()) {
-            cv_.wait(lock, [this] { return !response_queue_.empty() || stop_; });
+            if (flush_deadline == std::chrono::steady_clock::time_point::max()) {
+                cv_.wait(lock, has_work);
+            } else {
+                cv_.wait_until(lock, flush_deadline, has_work);
+            }
             if (!response_queue_.empty()) {
                 auto response = response_queue_.front();
                 response_queue_.pop();
                 lock.unlock();
                 inner_response_handler_->HandleResponse(response);
+                flush_deadline = inner_response_handler_->GetFlushDeadline();
+                lock.lock();
+                ++handled_count_;
+                cv_.notify_all();
+            } else if (std::chrono::steady_clock::now() >= flush_deadline) {
+                lock.unlock();
+                inner_response_handler_->Flush();
+                flush_deadline = inner_response_handler_->GetFlushDeadline();
                 lock.lock();
             }
         }
@@ -66,6 +98,8 @@ private:
     std::shared_ptr<ResponseHandler> inner_response_handler_;
     std::thread thread_;
     std::queue<Response> response_queue_;
+    size_t queued_count_ = 0;
+    size_t handled_count_ = 0;
     std::mutex mutex_;
     std::condition_variable cv_;
     std::atomic<bool> stop_ = false;
@@ -83,20 +117,24 @@ public:
         return global_context;
     }
 
-    void AddResponseHandler(std::shared_ptr<ResponseHandler> handler) {
+    void AddResponseHandler(std::shared_ptr<ResponseHandler> handler, SinkGroupId sink_group) {
+        std::lock_guard lock{mutex_};
         const auto async_response_handler = MakeAsyncResponseHandler(std::move(handler));
-        response_handlers_.push_back(async_response_handler);
-        for (const auto& [_, command_handler] : command_handlers_) {
-            std::ignore = _;
-            command_handler->AddResponseHandler(async_response_handler);
+        response_handlers_[sink_group].push_back(async_response_handler);
+        for (const auto& [context_id, command_handler] : command_handlers_) {
+            if (sink_group_by_context_id_.at(context_id) == sink_group) {
+                command_handler->AddResponseHandler(async_response_handler);
+            }
         }
     }
 
-    ContextId Connect(size_t block_size) {
+    ContextId Connect(size_t block_size, SinkGroupId sink_group) {
         std::lock_guard lock{mutex_};
         ContextId context_id = GetUniqueContextDescriptor();
         assert(!command_handlers_.count(context_id));
-        command_handlers_[context_id] = MakeCommandHandler(block_size);
+        command_handlers_[context_id] = MakeCommandHandler(block_size, sink_group);
+        sink_group_by_context_id_[context_id] = sink_group;
+        ++context_count_by_sink_group_[sink_group];
         return context_id;
     }
 
@@ -105,49 +143,82 @@ public:
         command_handlers_.at(context_id)->HandleCommand(command);
     }
 
+    // When the last context of a sink group disconnects, waits until the group's handlers have handled
+    // everything queued so far. The wait happens without the global lock, so other groups are not blocked.
     void Disconnect(ContextId context_id) {
-        std::lock_guard lock{mutex_};
-        command_handlers_.at(context_id)->Stop();
-        command_handlers_.erase(context_id);
-        if (command_handlers_.empty()) {
-            for (const auto& response_handler : response_handlers_) {
-                response_handler->Stop();
+        std::vector<std::pair<std::shared_ptr<AsyncResponseHandler>, size_t>> pending_handlers;
+        {
+            std::lock_guard lock{mutex_};
+            command_handlers_.at(context_id)->Stop();
+            command_handlers_.erase(context_id);
+            const auto sink_group = sink_group_by_context_id_.at(context_id);
+            sink_group_by_context_id_.erase(context_id);
+            if (--context_count_by_sink_group_.at(sink_group) == 0) {
+                context_count_by_sink_group_.erase(sink_group);
+                ForEachResponseHandler(sink_group, [&pending_handlers](const auto& response_handler) {
+                    pending_handlers.emplace_back(response_handler, response_handler->GetQueuedCount());
+                });
             }
         }
+        for (const auto& [response_handler, queued_count] : pending_handlers) {
+            response_handler->WaitUntilHandled(queued_count);
+        }
     }
 
     void ResetResponseHandlers() {
-        for (const auto& response_handler : response_handlers_) {
-            assert(response_handler->IsStopped());
+        std::vector<std::shared_ptr<AsyncResponseHandler>> response_handlers;
+        {
+            std::lock_guard lock{mutex_};
+            for (auto& [_, group_response_handlers] : response_handlers_) {
+                std::ignore = _;
+                response_handlers.insert(response_handlers.end(), group_response_handlers.begin(),
+                                         group_response_handlers.end());
+            }
+            response_handlers_.clear();
+            for (const auto& [_, command_handler] : command_handlers_) {
+                std::ignore = _;
+                command_handler->ResetResponseHandlers();
+            }
         }
-        response_handlers_.clear();
-        for (const auto& [_, command_handler] : command_handlers_) {
-            std::ignore = _;
-            command_handler->ResetResponseHandlers();
+        for (const auto& response_handler : response_handlers) {
+            response_handler->Stop();
         }
     }
 
 private:
-    std::shared_ptr<CommandHandler> MakeCommandHandler(size_t block_size) {
+    std::shared_ptr<CommandHandler> MakeCommandHandler(size_t block_size, SinkGroupId sink_group) {
         auto handler = std::make_shared<CommandHandler>(block_size);
-        for (const auto& response_handler : response_handlers_) {
+        ForEachResponseHandler(sink_group, [&handler](const auto& response_handler) {
             handler->AddResponseHandler(response_handler);
-        }
+        });
         return handler;
     }
 
+    template <typename Fn>
+    void ForEachResponseHandler(SinkGroupId sink_group, Fn fn) const {
+        const auto it = response_handlers_.find(sink_group);
+        if (it == response_handlers_.end()) {
+            return;
+        }
+        for (const auto& response_handler : it->second) {
+            fn(response_handler);
+        }
+    }
+
     std::unordered_map<ContextId, std::shared_ptr<CommandHandler>> command_handlers_;
-    std::vector<std::shared_ptr<AsyncResponseHandler>> response_handlers_;
+    std::unordered_map<ContextId, SinkGroupId> sink_group_by_context_id_;
+    std::unordered_map<SinkGroupId, size_t> context_count_by_sink_group_;
+    std::unordered_map<SinkGroupId, std::vector<std::shared_ptr<AsyncResponseHandler>>> response_handlers_;
     std::mutex mutex_;
 };
 
 
-void AddResponseHandler(std::shared_ptr<ResponseHandler> handler) {
-    GlobalContext::GetInstance().AddResponseHandler(std::move(handler));
+void AddResponseHandler(std::shared_ptr<ResponseHandler> handler, SinkGroupId sink_group) {
+    GlobalContext::GetInstance().AddResponseHandler(std::move(handler), sink_group);
 }
 
-ContextId Connect(size_t block_size) {
-    return GlobalContext::GetInstance().Connect(block_size);
+ContextId Connect(size_t block_size, SinkGroupId sink_group) {
+    return GlobalContext::GetInstance().Connect(block_size, sink_group);
 }
 
 void Receive(const std::string& command, ContextId context_id) {
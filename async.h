@@ -5,10 +5,15 @@
 namespace async {
 
 using ContextId = size_t;
+using SinkGroupId = size_t;
 
-void AddResponseHandler(std::shared_ptr<ResponseHandler> handler);
+// Contexts only send their blocks to the response handlers of their own sink group.
+// Each response handler runs on its own thread, so groups do not share sink queues.
+constexpr SinkGroupId kDefaultSinkGroup = 0;
 
-ContextId Connect(size_t block_size);
+void AddResponseHandler(std::shared_ptr<ResponseHandler> handler, SinkGroupId sink_group = kDefaultSinkGroup);
+
+ContextId Connect(size_t block_size, SinkGroupId sink_group = kDefaultSinkGroup);
 
 void Receive(const std::string& command, ContextId context_id);
 
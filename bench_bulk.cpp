@@ -0,0 +1,248 @@
+#include "async.h"
+#include "response_handler.h"
+#include "tokenizer.h"
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+static constexpr size_t kRepeatCount = 20;
+
+std::string MakeCommandCorpus(size_t command_count) {
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<size_t> command_size_distribution{1, 16};
+    std::uniform_int_distribution<size_t> block_distribution{0, 15};
+    std::string corpus;
+    for (size_t i = 0; i < command_count; ++i) {
+        const auto block = block_distribution(generator);
+        if (block == 0) {
+            corpus += "{\n";
+        } else if (block == 1) {
+            corpus += "}\n";
+        }
+        corpus += "cmd" + std::string(command_size_distribution(generator), 'a' + i % 26) + "\n";
+    }
+    return corpus;
+}
+
+// Runs fn kRepeatCount times and prints the throughput in MB/s, bytes is the amount of data processed by one run.
+void RunBenchmark(const std::string& name, size_t bytes, const std::function<size_t()>& fn) {
+    size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kRepeatCount; ++i) {
+        checksum += fn();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double mb_per_second = static_cast<double>(bytes * kRepeatCount) / elapsed.count() / 1e6;
+    std::cout << name << ": " << mb_per_second << " MB/s (checksum " << checksum << ")" << std::endl;
+}
+
+void BenchmarkTokenizer() {
+    const auto corpus = MakeCommandCorpus(1'000'000);
+    RunBenchmark("tokenizer/istream", corpus.size(), [&corpus] {
+        std::istringstream in{corpus};
+        std::string command;
+        size_t count = 0;
+        while (in >> command) {
+            ++count;
+        }
+        return count;
+    });
+    const std::pair<TokenizerIsa, std::string> isas[] = {
+            {TokenizerIsa::kScalar, "scalar"}, {TokenizerIsa::kSse2, "sse2"}, {TokenizerIsa::kAvx2, "avx2"}};
+    for (const auto& [isa, isa_name] : isas) {
+        if (IsTokenizerIsaSupported(isa)) {
+            RunBenchmark("tokenizer/" + isa_name, corpus.size(), [&corpus, isa = isa] {
+                return SplitCommands(corpus, isa).size();
+            });
+        }
+    }
+}
+
+void BenchmarkFormatter() {
+    static constexpr size_t kBlockCount = 100'000;
+    static constexpr size_t kBlockSize = 10;
+    const auto corpus = MakeCommandCorpus(kBlockCount * kBlockSize);
+    const auto commands = SplitCommands(corpus);
+    std::vector<Response> responses;
+    for (size_t i = 0; i + kBlockSize <= commands.size(); i += kBlockSize) {
+        responses.emplace_back(commands.begin() + i, commands.begin() + i + kBlockSize);
+    }
+
+    std::string expected;
+    for (const auto& response : responses) {
+        std::string buffer;
+        FormatResponse(response, buffer);
+        expected += buffer;
+    }
+
+    RunBenchmark("formatter/ostream", expected.size(), [&responses] {
+        std::ostringstream out;
+        for (const auto& response : responses) {
+            out << "bulk: ";
+            bool first = true;
+            for (const auto& command : response) {
+                if (!first) {
+                    out << ", ";
+                }
+                first = false;
+                out << command;
+            }
+            out << '\n';
+        }
+        return out.str().size();
+    });
+    RunBenchmark("formatter/buffer", expected.size(), [&responses] {
+        std::string buffer;
+        size_t size = 0;
+        for (const auto& response : responses) {
+            FormatResponse(response, buffer);
+            size += buffer.size();
+        }
+        return size;
+    });
+}
+
+// Simulates a sink that spends a fixed amount of time per block and remembers when it has seen
+// all blocks of the light tenant.
+class CostlyResponseHandler : public ResponseHandler {
+public:
+    CostlyResponseHandler(std::chrono::microseconds cost_per_block, size_t light_block_count)
+            : cost_per_block_(cost_per_block), light_block_count_(light_block_count) {
+    }
+
+    void HandleResponse(const Response& response) override {
+        if (response.empty()) {
+            return;
+        }
+        const auto deadline = std::chrono::steady_clock::now() + cost_per_block_;
+        while (std::chrono::steady_clock::now() < deadline) {
+        }
+        if (response.front().rfind("light", 0) == 0 && ++light_blocks_seen_ == light_block_count_) {
+            light_done_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    std::chrono::steady_clock::time_point GetLightDone() const {
+        return light_done_;
+    }
+
+private:
+    std::chrono::microseconds cost_per_block_;
+    size_t light_block_count_;
+    size_t light_blocks_seen_ = 0;
+    std::chrono::steady_clock::time_point light_done_;
+};
+
+// A heavy and a light tenant send blocks at the same time. Prints how long it takes until the light
+// tenant's blocks reach its sink, and until all sinks are drained.
+void RunSkewedTenants(const std::string& name, async::SinkGroupId heavy_group, async::SinkGroupId light_group) {
+    static constexpr size_t kBlockSize = 10;
+    static constexpr size_t kHeavyBlockCount = 10'000;
+    static constexpr size_t kLightBlockCount = 100;
+    static constexpr std::chrono::microseconds kCostPerBlock{20};
+
+    async::ResetResponseHandlers();
+    const auto heavy_handler = std::make_shared<CostlyResponseHandler>(kCostPerBlock, kLightBlockCount);
+    const auto light_handler = std::make_shared<CostlyResponseHandler>(kCostPerBlock, kLightBlockCount);
+    async::AddResponseHandler(heavy_handler, heavy_group);
+    async::AddResponseHandler(light_handler, light_group);
+    const auto heavy_context_id = async::Connect(kBlockSize, heavy_group);
+    const auto light_context_id = async::Connect(kBlockSize, light_group);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread heavy_thread{[heavy_context_id] {
+        for (size_t i = 0; i < kHeavyBlockCount * kBlockSize; ++i) {
+            async::Receive("heavy" + std::to_string(i), heavy_context_id);
+        }
+    }};
+    std::thread light_thread{[light_context_id] {
+        for (size_t i = 0; i < kLightBlockCount * kBlockSize; ++i) {
+            async::Receive("light" + std::to_string(i), light_context_id);
+        }
+    }};
+    heavy_thread.join();
+    light_thread.join();
+    async::Disconnect(heavy_context_id);
+    async::Disconnect(light_context_id);
+    const auto finish = std::chrono::steady_clock::now();
+
+    const auto light_done = std::max(heavy_handler->GetLightDone(), light_handler->GetLightDone());
+    const std::chrono::duration<double, std::milli> light_latency = light_done - start;
+    const std::chrono::duration<double, std::milli> total = finish - start;
+    std::cout << name << ": light tenant delivered in " << light_latency.count() << " ms, all sinks drained in "
+              << total.count() << " ms" << std::endl;
+}
+
+void BenchmarkSkewedTenants() {
+    RunSkewedTenants("tenants/shared", async::kDefaultSinkGroup, async::kDefaultSinkGroup);
+    RunSkewedTenants("tenants/isolated", 1, 2);
+}
+
+// Sends the commands through the async library to the handler, so batching and flushing happen the same way as
+// in otus8. Prints the throughput of the uncompressed text and the resulting file size relative to it.
+void RunFileSink(const std::string& name, const std::string& file_name, const std::vector<std::string>& commands,
+                 size_t block_size, size_t text_size,
+                 const std::function<std::shared_ptr<ResponseHandler>()>& make_handler) {
+    async::ResetResponseHandlers();
+    const auto start = std::chrono::steady_clock::now();
+    async::AddResponseHandler(make_handler());
+    const auto context_id = async::Connect(block_size);
+    for (const auto& command : commands) {
+        async::Receive(command, context_id);
+    }
+    async::Disconnect(context_id);
+    // Stops the worker and destroys the handler, which writes the last batch and closes the file.
+    async::ResetResponseHandlers();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::ifstream file{file_name, std::ios::binary | std::ios::ate};
+    const auto file_size = static_cast<double>(file.tellg());
+    file.close();
+    std::remove(file_name.c_str());
+    std::cout << name << ": " << static_cast<double>(text_size) / elapsed.count() / 1e6 << " MB/s, ratio "
+              << static_cast<double>(text_size) / file_size << std::endl;
+}
+
+void BenchmarkCompressedFileSink() {
+    static constexpr size_t kBlockSize = 10;
+    const auto corpus = MakeCommandCorpus(1'000'000);
+    std::vector<std::string> commands;
+    for (const auto command : SplitCommands(corpus)) {
+        if (command != "{" && command != "}") {
+            commands.emplace_back(command);
+        }
+    }
+    size_t text_size = 0;
+    std::string buffer;
+    for (size_t i = 0; i < commands.size(); i += kBlockSize) {
+        const auto block_end = commands.begin() + std::min(i + kBlockSize, commands.size());
+        FormatResponse(Response(commands.begin() + i, block_end), buffer);
+        text_size += buffer.size();
+    }
+
+    const std::string file_name = "bench_bulk.log";
+    RunFileSink("file_sink/plain", file_name, commands, kBlockSize, text_size, [&file_name] {
+        return MakeFileResponseHandler(file_name);
+    });
+    for (const int level : {1, 6, 9}) {
+        RunFileSink("file_sink/gzip_" + std::to_string(level), file_name, commands, kBlockSize, text_size,
+                    [&file_name, level] {
+                        return MakeCompressedFileResponseHandler(file_name, CompressionCodec::kGzip, level);
+                    });
+    }
+}
+
+}  // anonymous namespace
+
+int main() {
+    BenchmarkTokenizer();
+    BenchmarkFormatter();
+    BenchmarkSkewedTenants();
+    BenchmarkCompressedFileSink();
+    return 0;
+}
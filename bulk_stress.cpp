@@ -0,0 +1,289 @@
+#include "async.h"
+#include "bulk.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+struct WorkloadOptions {
+    uint64_t seed;
+    size_t context_count;
+    size_t thread_count;
+    size_t sink_count;
+    size_t sink_group_count;
+    size_t command_count;
+    size_t block_size;
+    size_t min_command_size;
+    size_t max_command_size;
+    double nested_block_probability;
+    double churn_probability;
+};
+
+// Commands sent between one Connect and the matching Disconnect.
+struct Session {
+    size_t id;
+    async::SinkGroupId sink_group;
+    std::vector<std::string> commands;
+};
+
+// Sessions of one logical client, replayed one after another by a single thread.
+using ClientScript = std::vector<Session>;
+
+std::string MakeCommand(size_t session_id, size_t command_index, size_t command_size) {
+    auto command = "s" + std::to_string(session_id) + "_" + std::to_string(command_index);
+    if (command.size() < command_size) {
+        command.resize(command_size, 'x');
+    }
+    return command;
+}
+
+std::vector<ClientScript> GenerateWorkload(const WorkloadOptions& options) {
+    std::mt19937_64 generator{options.seed};
+    std::uniform_int_distribution<size_t> command_size_distribution{options.min_command_size,
+                                                                    options.max_command_size};
+    std::bernoulli_distribution nested_block_distribution{options.nested_block_probability};
+    std::bernoulli_distribution churn_distribution{options.churn_probability};
+
+    std::vector<ClientScript> scripts(options.context_count);
+    size_t session_id = 0;
+    for (size_t client_index = 0; client_index < scripts.size(); ++client_index) {
+        auto& script = scripts[client_index];
+        const async::SinkGroupId sink_group = client_index % options.sink_group_count;
+        script.push_back({session_id++, sink_group, {}});
+        size_t nesting = 0;
+        for (size_t i = 0; i < options.command_count; ++i) {
+            auto& session = script.back();
+            if (nested_block_distribution(generator)) {
+                session.commands.emplace_back("{");
+                ++nesting;
+            } else if (nesting > 0 && nested_block_distribution(generator)) {
+                session.commands.emplace_back("}");
+                --nesting;
+            } else {
+                session.commands.push_back(
+                        MakeCommand(session.id, session.commands.size(), command_size_distribution(generator)));
+            }
+            if (i + 1 < options.command_count && churn_distribution(generator)) {
+                script.push_back({session_id++, sink_group, {}});
+                nesting = 0;
+            }
+        }
+    }
+    return scripts;
+}
+
+class CollectingResponseHandler : public ResponseHandler {
+public:
+    void HandleResponse(const Response& response) override {
+        if (!response.empty()) {
+            responses_.push_back(response);
+        }
+    }
+
+    std::vector<Response> GetResponses() const {
+        return responses_;
+    }
+
+private:
+    std::vector<Response> responses_;
+};
+
+// Replays the session through a single-threaded CommandHandler to get the expected blocks.
+std::vector<Response> RunOracle(const Session& session, size_t block_size) {
+    CommandHandler handler{block_size};
+    const auto collector = std::make_shared<CollectingResponseHandler>();
+    handler.AddResponseHandler(collector);
+    for (const auto& command : session.commands) {
+        handler.HandleCommand(command);
+    }
+    handler.Stop();
+    return collector->GetResponses();
+}
+
+// Groups received blocks by the session encoded in their commands. Blocks of one session
+// must arrive in the order the oracle produces them.
+class VerifyingResponseHandler : public ResponseHandler {
+public:
+    explicit VerifyingResponseHandler(size_t session_count) : responses_by_session_(session_count) {
+    }
+
+    void HandleResponse(const Response& response) override {
+        if (response.empty()) {
+            return;
+        }
+        const auto& command = response.front();
+        assert(command.size() > 1 && command[0] == 's');
+        const size_t session_id = std::stoull(command.substr(1, command.find('_') - 1));
+        responses_by_session_.at(session_id).push_back(response);
+    }
+
+    const std::vector<Response>& GetSessionResponses(size_t session_id) const {
+        return responses_by_session_.at(session_id);
+    }
+
+private:
+    std::vector<std::vector<Response>> responses_by_session_;
+};
+
+// Sends the commands of the given clients interleaved, one command per client in turn.
+// Returns the latency of every Receive call.
+std::vector<std::chrono::nanoseconds> RunClients(const std::vector<const ClientScript*>& scripts, size_t block_size) {
+    struct ClientState {
+        const ClientScript* script;
+        size_t session_index = 0;
+        size_t command_index = 0;
+        bool connected = false;
+        async::ContextId context_id = 0;
+    };
+
+    std::vector<ClientState> clients;
+    for (const auto* script : scripts) {
+        clients.push_back({script});
+    }
+    std::vector<std::chrono::nanoseconds> latencies;
+    size_t active_client_count = clients.size();
+    while (active_client_count > 0) {
+        for (auto& client : clients) {
+            if (client.session_index == client.script->size()) {
+                continue;
+            }
+            const auto& session = (*client.script)[client.session_index];
+            if (!client.connected) {
+                client.context_id = async::Connect(block_size, session.sink_group);
+                client.connected = true;
+            }
+            if (client.command_index < session.commands.size()) {
+                const auto start = std::chrono::steady_clock::now();
+                async::Receive(session.commands[client.command_index], client.context_id);
+                latencies.push_back(std::chrono::steady_clock::now() - start);
+                ++client.command_index;
+            }
+            if (client.command_index == session.commands.size()) {
+                async::Disconnect(client.context_id);
+                client.connected = false;
+                client.command_index = 0;
+                if (++client.session_index == client.script->size()) {
+                    --active_client_count;
+                }
+            }
+        }
+    }
+    return latencies;
+}
+
+double Percentile(const std::vector<std::chrono::nanoseconds>& sorted_latencies, double percentile) {
+    if (sorted_latencies.empty()) {
+        return 0;
+    }
+    const auto index = static_cast<size_t>(percentile * static_cast<double>(sorted_latencies.size() - 1));
+    return std::chrono::duration<double, std::micro>(sorted_latencies[index]).count();
+}
+
+int main(int ac, char** av) {
+    WorkloadOptions options{};
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("help", "produce help message")
+            ("seed", po::value(&options.seed)->default_value(42), "workload generator seed")
+            ("contexts", po::value(&options.context_count)->default_value(8), "number of concurrent clients")
+            ("threads", po::value(&options.thread_count)->default_value(4), "number of threads sending commands")
+            ("sinks", po::value(&options.sink_count)->default_value(2), "number of response handlers per sink group")
+            ("sink-groups", po::value(&options.sink_group_count)->default_value(2),
+                    "number of sink groups, clients are spread across them round-robin")
+            ("commands", po::value(&options.command_count)->default_value(10000), "commands per client")
+            ("block-size", po::value(&options.block_size)->default_value(10))
+            ("min-command-size", po::value(&options.min_command_size)->default_value(4))
+            ("max-command-size", po::value(&options.max_command_size)->default_value(32))
+            ("nested-block-probability", po::value(&options.nested_block_probability)->default_value(0.02),
+                    "probability to open (and, inside a block, to close) a dynamic block instead of a command")
+            ("churn-probability", po::value(&options.churn_probability)->default_value(0.001),
+                    "probability to disconnect and reconnect after each command")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+    if (options.thread_count == 0 || options.sink_count == 0 || options.sink_group_count == 0 ||
+        options.block_size == 0 ||
+        options.min_command_size > options.max_command_size) {
+        std::cout << "Invalid options" << std::endl;
+        return 1;
+    }
+
+    const auto scripts = GenerateWorkload(options);
+    size_t session_count = 0;
+    size_t command_count = 0;
+    for (const auto& script : scripts) {
+        session_count += script.size();
+        for (const auto& session : script) {
+            command_count += session.commands.size();
+        }
+    }
+
+    // sinks[i] belongs to sink group i / sink_count.
+    std::vector<std::shared_ptr<VerifyingResponseHandler>> sinks;
+    for (size_t i = 0; i < options.sink_group_count * options.sink_count; ++i) {
+        sinks.push_back(std::make_shared<VerifyingResponseHandler>(session_count));
+        async::AddResponseHandler(sinks.back(), i / options.sink_count);
+    }
+
+    std::vector<std::vector<std::chrono::nanoseconds>> latencies_by_thread(options.thread_count);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t thread_index = 0; thread_index < options.thread_count; ++thread_index) {
+        std::vector<const ClientScript*> thread_scripts;
+        for (size_t i = thread_index; i < scripts.size(); i += options.thread_count) {
+            thread_scripts.push_back(&scripts[i]);
+        }
+        threads.emplace_back([thread_scripts, &options, &latencies = latencies_by_thread[thread_index]] {
+            latencies = RunClients(thread_scripts, options.block_size);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Each group's last Disconnect drains its sinks, so all output has been handled at this point.
+    const std::chrono::duration<double> total_time = std::chrono::steady_clock::now() - start;
+
+    size_t mismatch_count = 0;
+    for (const auto& script : scripts) {
+        for (const auto& session : script) {
+            const auto expected = RunOracle(session, options.block_size);
+            for (size_t sink_index = 0; sink_index < sinks.size(); ++sink_index) {
+                // Sinks of other groups must not see the session at all.
+                const bool is_session_sink = sink_index / options.sink_count == session.sink_group;
+                const auto& responses = sinks[sink_index]->GetSessionResponses(session.id);
+                if (is_session_sink ? responses != expected : !responses.empty()) {
+                    if (mismatch_count == 0) {
+                        std::cout << "Output mismatch: session " << session.id << ", sink " << sink_index
+                                  << std::endl;
+                    }
+                    ++mismatch_count;
+                }
+            }
+        }
+    }
+
+    std::vector<std::chrono::nanoseconds> latencies;
+    for (const auto& thread_latencies : latencies_by_thread) {
+        latencies.insert(latencies.end(), thread_latencies.begin(), thread_latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "seed: " << options.seed << std::endl;
+    std::cout << "sessions: " << session_count << ", commands: " << command_count << std::endl;
+    std::cout << "end-to-end throughput: " << static_cast<double>(command_count) / total_time.count()
+              << " commands/s" << std::endl;
+    std::cout << "receive latency, us: p50 " << Percentile(latencies, 0.5) << ", p99 " << Percentile(latencies, 0.99)
+              << ", p99.9 " << Percentile(latencies, 0.999) << ", max " << Percentile(latencies, 1) << std::endl;
+    std::cout << "mismatched sessions: " << mismatch_count << std::endl;
+
+    return mismatch_count == 0 ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include "bulk.h"
 #include "async.h"
 #include "response_handler.h"
+#include "tokenizer.h"
 #include <boost/program_options.hpp>
 
 namespace po = boost::program_options;
@@ -14,6 +15,7 @@ int main(int ac, char** av) {
     desc.add_options()
             ("help", "produce help message")
             ("block-size", po::value<size_t>())
+            ("compress", "write gzip-compressed bulk logs")
     ;
     po::positional_options_description pos_desc;
     pos_desc.add("block-size", -1);
@@ -34,16 +36,27 @@ int main(int ac, char** av) {
     }
 
     async::AddResponseHandler(MakeOstreamResponseHandler(std::cout));
-    async::AddResponseHandler(MakeFileResponseHandler(MakeBulkFileName("_1")));
-    async::AddResponseHandler(MakeFileResponseHandler(MakeBulkFileName("_2")));
+    if (vm.count("compress")) {
+        async::AddResponseHandler(MakeCompressedFileResponseHandler(
+                MakeBulkFileName("_1") + ".gz", CompressionCodec::kGzip, kDefaultCompressionLevel));
+        async::AddResponseHandler(MakeCompressedFileResponseHandler(
+                MakeBulkFileName("_2") + ".gz", CompressionCodec::kGzip, kDefaultCompressionLevel));
+    } else {
+        async::AddResponseHandler(MakeFileResponseHandler(MakeBulkFileName("_1")));
+        async::AddResponseHandler(MakeFileResponseHandler(MakeBulkFileName("_2")));
+    }
 
     const auto context_id = async::Connect(vm["block-size"].as<size_t>());
-    std::string command;
-    while (std::cin >> command) {
-        if (command == ":stop") {
-            break;
+    std::string line;
+    bool stop = false;
+    while (!stop && std::getline(std::cin, line)) {
+        for (const auto command : SplitCommands(line)) {
+            if (command == ":stop") {
+                stop = true;
+                break;
+            }
+            async::Receive(std::string{command}, context_id);
         }
-        async::Receive(command, context_id);
     }
     async::Disconnect(context_id);
 
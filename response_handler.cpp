@@ -1,6 +1,40 @@
 #include "response_handler.h"
 #include <iostream>
 #include <fstream>
+#include <cstring>
+#include <zlib.h>
+
+namespace {
+
+constexpr std::string_view kBulkPrefix = "bulk: ";
+constexpr std::string_view kCommandDelimiter = ", ";
+
+char* Append(char* out, std::string_view data) {
+    std::memcpy(out, data.data(), data.size());
+    return out + data.size();
+}
+
+}  // anonymous namespace
+
+void FormatResponse(const Response& response, std::string& buffer) {
+    buffer.clear();
+    if (response.empty()) {
+        return;
+    }
+    size_t size = kBulkPrefix.size() + kCommandDelimiter.size() * (response.size() - 1) + 1;
+    for (const auto& command : response) {
+        size += command.size();
+    }
+    buffer.resize(size);
+
+    char* out = Append(buffer.data(), kBulkPrefix);
+    out = Append(out, response.front());
+    for (size_t i = 1; i < response.size(); ++i) {
+        out = Append(out, kCommandDelimiter);
+        out = Append(out, response[i]);
+    }
+    *out = '\n';
+}
 
 class AbstractOstreamResponseHandler : public ResponseHandler {
 public:
@@ -10,20 +44,16 @@ public:
         if (response.empty()) {
             return;
         }
-        out << "bulk: ";
-        bool first = true;
-        for (const auto& command : response) {
-            if (!first) {
-                out << ", ";
-            }
-            first = false;
-            out << command;
-        }
-        out << std::endl;
+        FormatResponse(response, buffer_);
+        out.write(buffer_.data(), buffer_.size());
+        out.flush();
     }
 
 protected:
     virtual std::ostream& GetOstream() = 0;
+
+private:
+    std::string buffer_;
 };
 
 class OstreamResponseHandler : public AbstractOstreamResponseHandler {
@@ -54,10 +84,119 @@ private:
     std::ofstream file_;
 };
 
+class Compressor {
+public:
+    // Compresses input into output as a frame that can be decoded without the previous ones.
+    virtual void CompressFrame(std::string& input, std::string& output) = 0;
+    virtual ~Compressor() = default;
+};
+
+class GzipCompressor : public Compressor {
+public:
+    explicit GzipCompressor(int compression_level) {
+        // 16 is added to the window bits to get gzip framing instead of zlib one.
+        [[maybe_unused]] const int result = deflateInit2(&stream_, compression_level, Z_DEFLATED, 15 + 16, 8,
+                                                         Z_DEFAULT_STRATEGY);
+        assert(result == Z_OK);
+    }
+
+    ~GzipCompressor() override {
+        deflateEnd(&stream_);
+    }
+
+    // Every frame is a separate gzip member, concatenated members form a valid gzip file.
+    void CompressFrame(std::string& input, std::string& output) override {
+        output.resize(deflateBound(&stream_, input.size()));
+        stream_.next_in = reinterpret_cast<Bytef*>(input.data());
+        stream_.avail_in = input.size();
+        stream_.next_out = reinterpret_cast<Bytef*>(output.data());
+        stream_.avail_out = output.size();
+        [[maybe_unused]] const int result = deflate(&stream_, Z_FINISH);
+        assert(result == Z_STREAM_END);
+        output.resize(output.size() - stream_.avail_out);
+        deflateReset(&stream_);
+    }
+
+private:
+    z_stream stream_{};
+};
+
+std::unique_ptr<Compressor> MakeCompressor(CompressionCodec codec, int compression_level) {
+    switch (codec) {
+        case CompressionCodec::kGzip:
+            return std::make_unique<GzipCompressor>(compression_level);
+    }
+    assert(false);
+    return nullptr;
+}
+
+class CompressedFileResponseHandler : public ResponseHandler {
+public:
+    CompressedFileResponseHandler(const std::string& file_name, CompressionCodec codec, int compression_level,
+                                  size_t batch_size, std::chrono::milliseconds max_batch_age)
+            : file_(file_name, std::ios::binary), compressor_(MakeCompressor(codec, compression_level)),
+              batch_size_(batch_size), max_batch_age_(max_batch_age) {
+    }
+
+    ~CompressedFileResponseHandler() override {
+        Flush();
+    }
+
+    void HandleResponse(const Response& response) override {
+        assert(file_.good());
+        if (response.empty()) {
+            return;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (batch_.empty()) {
+            batch_start_ = now;
+        }
+        FormatResponse(response, buffer_);
+        batch_ += buffer_;
+        if (batch_.size() >= batch_size_ || now - batch_start_ >= max_batch_age_) {
+            Flush();
+        }
+    }
+
+    std::chrono::steady_clock::time_point GetFlushDeadline() const override {
+        if (batch_.empty()) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        return batch_start_ + max_batch_age_;
+    }
+
+    void Flush() override {
+        if (batch_.empty()) {
+            return;
+        }
+        compressor_->CompressFrame(batch_, compressed_);
+        file_.write(compressed_.data(), compressed_.size());
+        file_.flush();
+        batch_.clear();
+    }
+
+private:
+    std::ofstream file_;
+    std::unique_ptr<Compressor> compressor_;
+    size_t batch_size_;
+    std::chrono::milliseconds max_batch_age_;
+    std::chrono::steady_clock::time_point batch_start_;
+    std::string buffer_;
+    std::string batch_;
+    std::string compressed_;
+};
+
 std::shared_ptr<ResponseHandler> MakeOstreamResponseHandler(std::ostream& out) {
     return std::make_shared<OstreamResponseHandler>(out);
 }
 
 std::shared_ptr<ResponseHandler> MakeFileResponseHandler(const std::string& file_name) {
     return std::make_shared<FileResponseHandler>(file_name);
-}
\ No newline at end of file
+}
+
+std::shared_ptr<ResponseHandler> MakeCompressedFileResponseHandler(
+        const std::string& file_name, CompressionCodec codec, int compression_level, size_t batch_size,
+        std::chrono::milliseconds max_batch_age) {
+    return std::make_shared<CompressedFileResponseHandler>(file_name, codec, compression_level, batch_size,
+                                                           max_batch_age);
+}
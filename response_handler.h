@@ -12,8 +12,36 @@ using Response = std::vector<std::string>;
 class ResponseHandler {
 public:
     virtual void HandleResponse(const Response& response) = 0;
+    // Returns the time by which buffered output has to be written, time_point::max() if nothing is buffered.
+    virtual std::chrono::steady_clock::time_point GetFlushDeadline() const {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    // Writes buffered output. The async library calls it once GetFlushDeadline has passed without new responses.
+    virtual void Flush() {
+    }
     virtual ~ResponseHandler() = default;
 };
 
+// Writes "bulk: cmd1, cmd2, ...\n" into buffer, reusing its capacity. An empty response produces an empty buffer.
+void FormatResponse(const Response& response, std::string& buffer);
+
 std::shared_ptr<ResponseHandler> MakeOstreamResponseHandler(std::ostream& out);
 std::shared_ptr<ResponseHandler> MakeFileResponseHandler(const std::string& file_name);
+
+// Only gzip is available for now: lz4 and zstd development headers are missing in the build environment.
+enum class CompressionCodec {
+    kGzip,
+};
+
+constexpr int kDefaultCompressionLevel = 6;
+constexpr size_t kDefaultCompressionBatchSize = 64 * 1024;
+constexpr std::chrono::milliseconds kDefaultCompressionMaxBatchAge{1000};
+
+// Writes compressed bulk log. Responses are collected until batch_size bytes of text are pending, the oldest
+// pending response is older than max_batch_age or Flush is called. Each batch is written as an independent frame,
+// so a truncated file stays readable up to the last complete batch.
+// For gzip the level is the zlib level: 1 is the fastest, 9 gives the best ratio.
+std::shared_ptr<ResponseHandler> MakeCompressedFileResponseHandler(
+        const std::string& file_name, CompressionCodec codec, int compression_level,
+        size_t batch_size = kDefaultCompressionBatchSize,
+        std::chrono::milliseconds max_batch_age = kDefaultCompressionMaxBatchAge);
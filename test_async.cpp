@@ -6,6 +6,8 @@
 #include <mutex>
 #include <condition_variable>
 #include <thread>
+#include <future>
+#include <optional>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 #include <boost/test/unit_test.hpp>
@@ -128,7 +130,7 @@ public:
     }
 
     void CheckExpectedCommandCount(size_t expected_command_count) const {
-        for (const auto [_, command_count] : command_count_by_thread_and_context_id_) {
+        for (const auto& [_, command_count] : command_count_by_thread_and_context_id_) {
             std::ignore = _;
             assert(command_count == expected_command_count);
         }
@@ -177,3 +179,208 @@ BOOST_AUTO_TEST_CASE(stress_test) {
 }
 
 }
+
+BOOST_AUTO_TEST_SUITE(test_sink_groups)
+
+class RecordingResponseHandler : public ResponseHandler {
+public:
+    void HandleResponse(const Response& response) override {
+        std::unique_lock lock{mutex_};
+        cv_.wait(lock, [this] { return !blocked_; });
+        if (!response.empty()) {
+            if (flushed_response_count_ == responses_.size()) {
+                first_unflushed_time_ = std::chrono::steady_clock::now();
+            }
+            responses_.push_back(response);
+        }
+        cv_.notify_all();
+    }
+
+    std::chrono::steady_clock::time_point GetFlushDeadline() const override {
+        std::lock_guard lock{mutex_};
+        if (!flush_delay_ || flushed_response_count_ == responses_.size()) {
+            return std::chrono::steady_clock::time_point::max();
+        }
+        return first_unflushed_time_ + *flush_delay_;
+    }
+
+    void SetFlushDelay(std::chrono::milliseconds flush_delay) {
+        std::lock_guard lock{mutex_};
+        flush_delay_ = flush_delay;
+    }
+
+    size_t GetFlushedResponseCount() {
+        std::lock_guard lock{mutex_};
+        return flushed_response_count_;
+    }
+
+    void Flush() override {
+        std::lock_guard lock{mutex_};
+        flushed_response_count_ = responses_.size();
+        cv_.notify_all();
+    }
+
+    bool WaitForFlushedResponseCount(size_t response_count) {
+        std::unique_lock lock{mutex_};
+        return cv_.wait_for(lock, std::chrono::milliseconds(500),
+                            [this, response_count] { return flushed_response_count_ >= response_count; });
+    }
+
+    void SetBlocked(bool blocked) {
+        std::lock_guard lock{mutex_};
+        blocked_ = blocked;
+        cv_.notify_all();
+    }
+
+    bool WaitForResponseCount(size_t response_count) {
+        std::unique_lock lock{mutex_};
+        return cv_.wait_for(lock, std::chrono::milliseconds(500),
+                            [this, response_count] { return responses_.size() >= response_count; });
+    }
+
+    std::vector<Response> GetResponses() {
+        std::lock_guard lock{mutex_};
+        return responses_;
+    }
+
+private:
+    std::vector<Response> responses_;
+    size_t flushed_response_count_ = 0;
+    std::optional<std::chrono::milliseconds> flush_delay_;
+    std::chrono::steady_clock::time_point first_unflushed_time_;
+    bool blocked_ = false;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+static constexpr async::SinkGroupId kFirstSinkGroup = 1;
+static constexpr async::SinkGroupId kSecondSinkGroup = 2;
+
+BOOST_AUTO_TEST_CASE(test_isolation) {
+    async::ResetResponseHandlers();
+    const auto first_handler = std::make_shared<RecordingResponseHandler>();
+    const auto second_handler = std::make_shared<RecordingResponseHandler>();
+    async::AddResponseHandler(first_handler, kFirstSinkGroup);
+    async::AddResponseHandler(second_handler, kSecondSinkGroup);
+
+    const auto first_context_id = async::Connect(2, kFirstSinkGroup);
+    const auto second_context_id = async::Connect(2, kSecondSinkGroup);
+    async::Receive("cmd1", first_context_id);
+    async::Receive("cmd2", second_context_id);
+    async::Receive("cmd3", first_context_id);
+    async::Receive("cmd4", second_context_id);
+    async::Receive("cmd5", first_context_id);
+    async::Disconnect(first_context_id);
+    async::Disconnect(second_context_id);
+
+    BOOST_CHECK(first_handler->GetResponses() == (std::vector<Response>{{"cmd1", "cmd3"}, {"cmd5"}}));
+    BOOST_CHECK(second_handler->GetResponses() == (std::vector<Response>{{"cmd2", "cmd4"}}));
+}
+
+BOOST_AUTO_TEST_CASE(test_slow_sink_group) {
+    static constexpr size_t kBlockCount = 100;
+
+    async::ResetResponseHandlers();
+    const auto slow_handler = std::make_shared<RecordingResponseHandler>();
+    const auto fast_handler = std::make_shared<RecordingResponseHandler>();
+    async::AddResponseHandler(slow_handler, kFirstSinkGroup);
+    async::AddResponseHandler(fast_handler, kSecondSinkGroup);
+    slow_handler->SetBlocked(true);
+
+    const auto slow_context_id = async::Connect(1, kFirstSinkGroup);
+    const auto fast_context_id = async::Connect(1, kSecondSinkGroup);
+    for (size_t i = 0; i < kBlockCount; ++i) {
+        async::Receive("cmd" + std::to_string(i), slow_context_id);
+    }
+    async::Receive("cmd", fast_context_id);
+
+    BOOST_CHECK(fast_handler->WaitForResponseCount(1));
+    BOOST_CHECK(slow_handler->GetResponses().empty());
+
+    slow_handler->SetBlocked(false);
+    BOOST_CHECK(slow_handler->WaitForResponseCount(kBlockCount));
+    async::Disconnect(slow_context_id);
+    async::Disconnect(fast_context_id);
+    BOOST_CHECK_EQUAL(fast_handler->GetResponses().size(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_reconnect_sink_group) {
+    async::ResetResponseHandlers();
+    const auto handler = std::make_shared<RecordingResponseHandler>();
+    async::AddResponseHandler(handler, kFirstSinkGroup);
+
+    const auto first_context_id = async::Connect(2, kFirstSinkGroup);
+    async::Receive("cmd1", first_context_id);
+    async::Disconnect(first_context_id);
+    BOOST_CHECK(handler->GetResponses() == (std::vector<Response>{{"cmd1"}}));
+
+    const auto second_context_id = async::Connect(2, kFirstSinkGroup);
+    async::Receive("cmd2", second_context_id);
+    async::Receive("cmd3", second_context_id);
+    BOOST_CHECK(handler->WaitForResponseCount(2));
+    async::Receive("cmd4", second_context_id);
+    async::Disconnect(second_context_id);
+    BOOST_CHECK(handler->GetResponses() == (std::vector<Response>{{"cmd1"}, {"cmd2", "cmd3"}, {"cmd4"}}));
+}
+
+
+BOOST_AUTO_TEST_CASE(test_disconnect_backlogged_sink_group) {
+    static constexpr size_t kBlockCount = 1000;
+    static constexpr size_t kFastCommandCount = 100;
+
+    async::ResetResponseHandlers();
+    const auto slow_handler = std::make_shared<RecordingResponseHandler>();
+    const auto fast_handler = std::make_shared<RecordingResponseHandler>();
+    async::AddResponseHandler(slow_handler, kFirstSinkGroup);
+    async::AddResponseHandler(fast_handler, kSecondSinkGroup);
+    slow_handler->SetBlocked(true);
+
+    const auto slow_context_id = async::Connect(1, kFirstSinkGroup);
+    const auto fast_context_id = async::Connect(1, kSecondSinkGroup);
+    for (size_t i = 0; i < kBlockCount; ++i) {
+        async::Receive("cmd" + std::to_string(i), slow_context_id);
+    }
+    // Waits until the slow group's backlog is handled, which cannot happen while its handler is blocked.
+    auto slow_disconnect = std::async(std::launch::async, [slow_context_id] {
+        async::Disconnect(slow_context_id);
+    });
+    BOOST_CHECK(slow_disconnect.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+
+    // The other group keeps working while the slow group drains.
+    auto fast_commands = std::async(std::launch::async, [fast_context_id] {
+        for (size_t i = 0; i < kFastCommandCount; ++i) {
+            async::Receive("cmd" + std::to_string(i), fast_context_id);
+        }
+        const auto context_id = async::Connect(1, kSecondSinkGroup);
+        async::Disconnect(context_id);
+    });
+    BOOST_CHECK(fast_commands.wait_for(std::chrono::milliseconds(500)) == std::future_status::ready);
+    BOOST_CHECK(fast_handler->WaitForResponseCount(kFastCommandCount));
+
+    slow_handler->SetBlocked(false);
+    slow_disconnect.get();
+    fast_commands.get();
+    BOOST_CHECK_EQUAL(slow_handler->GetResponses().size(), kBlockCount);
+    async::Disconnect(fast_context_id);
+}
+
+BOOST_AUTO_TEST_CASE(test_flush_deadline) {
+    static constexpr std::chrono::milliseconds kFlushDelay{200};
+
+    async::ResetResponseHandlers();
+    const auto handler = std::make_shared<RecordingResponseHandler>();
+    handler->SetFlushDelay(kFlushDelay);
+    async::AddResponseHandler(handler, kFirstSinkGroup);
+
+    const auto context_id = async::Connect(1, kFirstSinkGroup);
+    const auto start = std::chrono::steady_clock::now();
+    async::Receive("cmd1", context_id);
+    BOOST_CHECK(handler->WaitForResponseCount(1));
+    // An idle queue alone does not flush, the worker wakes up at the deadline without new responses.
+    BOOST_CHECK_EQUAL(handler->GetFlushedResponseCount(), 0);
+    BOOST_CHECK(handler->WaitForFlushedResponseCount(1));
+    BOOST_CHECK(std::chrono::steady_clock::now() - start >= kFlushDelay);
+    async::Disconnect(context_id);
+}
+
+}
@@ -1,7 +1,12 @@
 #define BOOST_TEST_MODULE test_bulk
 
 #include "bulk.h"
+#include "tokenizer.h"
 #include <set>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <zlib.h>
 #include <boost/filesystem.hpp>
 
 #include <boost/test/unit_test.hpp>
@@ -56,6 +61,134 @@ BOOST_AUTO_TEST_CASE(test_FileResponseHandler) {
     });
 }
 
+std::string ReadCompressedFile(const std::string& file_name) {
+    BOOST_CHECK(fs::exists(file_name));
+    gzFile file = gzopen(file_name.c_str(), "rb");
+    BOOST_REQUIRE(file != nullptr);
+    std::string result;
+    char buffer[4096];
+    int read_size;
+    while ((read_size = gzread(file, buffer, sizeof(buffer))) > 0) {
+        result.append(buffer, read_size);
+    }
+    gzclose(file);
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(test_CompressedFileResponseHandler) {
+    std::string file_name = "test_file.log.gz";
+    if (fs::exists(file_name)) {
+        fs::remove(file_name);
+    }
+    std::shared_ptr<ResponseHandler> handler = MakeCompressedFileResponseHandler(file_name, CompressionCodec::kGzip, 1, 0);
+
+    TestResponseHandler(handler.get(), [&file_name]() { return ReadCompressedFile(file_name); });
+}
+
+BOOST_AUTO_TEST_CASE(test_CompressedFileResponseHandler_batch) {
+    std::string file_name = "test_file.log.gz";
+    if (fs::exists(file_name)) {
+        fs::remove(file_name);
+    }
+    std::shared_ptr<ResponseHandler> handler = MakeCompressedFileResponseHandler(file_name, CompressionCodec::kGzip, 9, 20);
+
+    handler->HandleResponse({"cmd1", "cmd2"});
+    BOOST_CHECK_EQUAL("", ReadCompressedFile(file_name));
+    handler->HandleResponse({"cmd3", "cmd4"});
+    const std::string first_batch = "bulk: cmd1, cmd2\nbulk: cmd3, cmd4\n";
+    BOOST_CHECK_EQUAL(first_batch, ReadCompressedFile(file_name));
+    handler->HandleResponse({"cmd5"});
+    BOOST_CHECK_EQUAL(first_batch, ReadCompressedFile(file_name));
+    handler.reset();
+    BOOST_CHECK_EQUAL(first_batch + "bulk: cmd5\n", ReadCompressedFile(file_name));
+}
+
+BOOST_AUTO_TEST_CASE(test_CompressedFileResponseHandler_flush) {
+    std::string file_name = "test_file.log.gz";
+    if (fs::exists(file_name)) {
+        fs::remove(file_name);
+    }
+    std::shared_ptr<ResponseHandler> handler = MakeCompressedFileResponseHandler(
+            file_name, CompressionCodec::kGzip, 6, kDefaultCompressionBatchSize, std::chrono::milliseconds(10));
+
+    BOOST_CHECK(handler->GetFlushDeadline() == std::chrono::steady_clock::time_point::max());
+    const auto start = std::chrono::steady_clock::now();
+    handler->HandleResponse({"cmd1"});
+    BOOST_CHECK_EQUAL("", ReadCompressedFile(file_name));
+    BOOST_CHECK(handler->GetFlushDeadline() >= start + std::chrono::milliseconds(10));
+    BOOST_CHECK(handler->GetFlushDeadline() <= std::chrono::steady_clock::now() + std::chrono::milliseconds(10));
+    handler->Flush();
+    BOOST_CHECK_EQUAL("bulk: cmd1\n", ReadCompressedFile(file_name));
+    BOOST_CHECK(handler->GetFlushDeadline() == std::chrono::steady_clock::time_point::max());
+
+    handler->HandleResponse({"cmd2"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    handler->HandleResponse({"cmd3"});
+    BOOST_CHECK_EQUAL("bulk: cmd1\nbulk: cmd2\nbulk: cmd3\n", ReadCompressedFile(file_name));
+}
+
+// Decodes gzip members one by one and returns the text of the complete ones, ignoring a truncated tail.
+std::string DecodeCompleteMembers(const std::string& data) {
+    z_stream stream{};
+    BOOST_REQUIRE_EQUAL(inflateInit2(&stream, 15 + 16), Z_OK);
+    std::string result;
+    std::string member;
+    char buffer[4096];
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = data.size();
+    while (stream.avail_in > 0) {
+        stream.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream.avail_out = sizeof(buffer);
+        const int status = inflate(&stream, Z_NO_FLUSH);
+        member.append(buffer, sizeof(buffer) - stream.avail_out);
+        if (status == Z_STREAM_END) {
+            result += member;
+            member.clear();
+            inflateReset(&stream);
+        } else if (status != Z_OK) {
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(test_CompressedFileResponseHandler_truncated) {
+    static constexpr size_t kMemberCount = 10;
+    std::string file_name = "test_file.log.gz";
+    if (fs::exists(file_name)) {
+        fs::remove(file_name);
+    }
+    std::shared_ptr<ResponseHandler> handler = MakeCompressedFileResponseHandler(
+            file_name, CompressionCodec::kGzip, 6, 0);
+
+    std::vector<size_t> member_ends;
+    std::vector<std::string> member_texts;
+    for (size_t i = 0; i < kMemberCount; ++i) {
+        const Response response{"cmd" + std::to_string(i), std::string(100, 'a' + i)};
+        handler->HandleResponse(response);
+        member_ends.push_back(fs::file_size(file_name));
+        std::string text;
+        FormatResponse(response, text);
+        member_texts.push_back(text);
+    }
+    handler.reset();
+
+    std::ifstream file{file_name, std::ios::binary};
+    const std::string data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    BOOST_REQUIRE_EQUAL(data.size(), member_ends.back());
+
+    std::string expected;
+    size_t member_begin = 0;
+    for (size_t i = 0; i < kMemberCount; ++i) {
+        const size_t truncated_size = (member_begin + member_ends[i]) / 2;
+        BOOST_CHECK_EQUAL(expected, DecodeCompleteMembers(data.substr(0, truncated_size)));
+        expected += member_texts[i];
+        BOOST_CHECK_EQUAL(expected, DecodeCompleteMembers(data.substr(0, member_ends[i])));
+        member_begin = member_ends[i];
+    }
+}
+
 }
 
 
@@ -133,4 +266,103 @@ BOOST_AUTO_TEST_CASE(test_CommandHandler_2) {
     TestStopCommand(handler, check_response_handler, {});
 }
 
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_SUITE(test_tokenizer)
+
+std::vector<std::string> SplitWithIstream(const std::string& input) {
+    std::istringstream in{input};
+    std::vector<std::string> result;
+    std::string command;
+    while (in >> command) {
+        result.push_back(command);
+    }
+    return result;
+}
+
+static constexpr TokenizerIsa kTokenizerIsas[] = {TokenizerIsa::kScalar, TokenizerIsa::kSse2, TokenizerIsa::kAvx2};
+
+// Checks every implementation the running CPU supports, not only the one SplitCommands picks.
+void CheckSplitCommands(const std::string& input) {
+    const auto expected = SplitWithIstream(input);
+    for (const auto isa : kTokenizerIsas) {
+        if (!IsTokenizerIsaSupported(isa)) {
+            continue;
+        }
+        const auto commands = SplitCommands(input, isa);
+        BOOST_REQUIRE_EQUAL(expected.size(), commands.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            BOOST_CHECK_EQUAL(expected[i], commands[i]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_TokenizerIsa) {
+    BOOST_CHECK(IsTokenizerIsaSupported(GetBestTokenizerIsa()));
+    for (const auto isa : kTokenizerIsas) {
+        BOOST_TEST_MESSAGE("tokenizer isa " << static_cast<int>(isa) << " supported: " << IsTokenizerIsaSupported(isa));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_SplitCommands) {
+    CheckSplitCommands("");
+    CheckSplitCommands("   \n\t ");
+    CheckSplitCommands("cmd1");
+    CheckSplitCommands("cmd1 cmd2\n{\ncmd3\t}\r\n");
+    CheckSplitCommands("  a{ }b {} " + std::string(100, 'x') + " " + std::string(33, ' ') + "y");
+}
+
+BOOST_AUTO_TEST_CASE(fuzz_SplitCommands) {
+    static constexpr size_t kTestCount = 2000;
+    static const std::string kAlphabet = std::string{"ab{}:  \t\n\v\f\r\x1f\x80\xff"} + '\0';
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<size_t> length_distribution{0, 200};
+    std::uniform_int_distribution<size_t> char_distribution{0, kAlphabet.size() - 1};
+    for (size_t i = 0; i < kTestCount; ++i) {
+        std::string input(length_distribution(generator), ' ');
+        for (auto& c : input) {
+            c = kAlphabet[char_distribution(generator)];
+        }
+        CheckSplitCommands(input);
+    }
+}
+
+std::string FormatWithOstream(const Response& response) {
+    std::ostringstream out;
+    if (response.empty()) {
+        return out.str();
+    }
+    out << "bulk: ";
+    bool first = true;
+    for (const auto& command : response) {
+        if (!first) {
+            out << ", ";
+        }
+        first = false;
+        out << command;
+    }
+    out << std::endl;
+    return out.str();
+}
+
+BOOST_AUTO_TEST_CASE(fuzz_FormatResponse) {
+    static constexpr size_t kTestCount = 2000;
+    std::mt19937 generator{42};
+    std::uniform_int_distribution<size_t> block_size_distribution{0, 20};
+    std::uniform_int_distribution<size_t> command_size_distribution{0, 40};
+    std::uniform_int_distribution<int> char_distribution{'!', '~'};
+    std::string buffer;
+    for (size_t i = 0; i < kTestCount; ++i) {
+        Response response(block_size_distribution(generator));
+        for (auto& command : response) {
+            command.resize(command_size_distribution(generator));
+            for (auto& c : command) {
+                c = static_cast<char>(char_distribution(generator));
+            }
+        }
+        FormatResponse(response, buffer);
+        BOOST_CHECK_EQUAL(FormatWithOstream(response), buffer);
+    }
+}
+
+}
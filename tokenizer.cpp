@@ -0,0 +1,164 @@
+#include "tokenizer.h"
+#include <cassert>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BULK_X86_TOKENIZER
+#endif
+
+namespace {
+
+std::vector<std::string_view> SplitCommandsScalar(std::string_view input) {
+    std::vector<std::string_view> commands;
+    size_t pos = 0;
+    while (pos < input.size()) {
+        while (pos < input.size() && IsCommandSeparator(input[pos])) {
+            ++pos;
+        }
+        const size_t command_begin = pos;
+        while (pos < input.size() && !IsCommandSeparator(input[pos])) {
+            ++pos;
+        }
+        if (pos != command_begin) {
+            commands.push_back(input.substr(command_begin, pos - command_begin));
+        }
+    }
+    return commands;
+}
+
+#ifdef BULK_X86_TOKENIZER
+
+// Each block type provides SeparatorMask, which sets bit i of the result if data[i] is a separator.
+// '\t', '\n', '\v', '\f' and '\r' are consecutive, so they are matched with c - '\t' <= '\r' - '\t'
+// compared as unsigned bytes.
+
+struct Sse2Block {
+    static constexpr size_t kSize = 16;
+
+    __attribute__((target("sse2"))) static uint32_t SeparatorMask(const char* data) {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i spaces = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+        const __m128i shifted = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+        const __m128i controls = _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted);
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(spaces, controls)));
+    }
+};
+
+struct Avx2Block {
+    static constexpr size_t kSize = 32;
+
+    __attribute__((target("avx2"))) static uint32_t SeparatorMask(const char* data) {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i spaces = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(' '));
+        const __m256i shifted = _mm256_sub_epi8(chars, _mm256_set1_epi8('\t'));
+        const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')),
+                                                   shifted);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(spaces, controls)));
+    }
+};
+
+// Always inlined into a function with the block's target, so SeparatorMask is inlined as well.
+template <typename Block>
+__attribute__((always_inline)) inline std::vector<std::string_view> SplitCommandsSimd(std::string_view input) {
+    static constexpr uint32_t kBlockMask = static_cast<uint32_t>((uint64_t{1} << Block::kSize) - 1);
+
+    std::vector<std::string_view> commands;
+    const char* data = input.data();
+    size_t command_begin = 0;
+    // The beginning of the input behaves like a separator.
+    uint32_t previous_is_separator = 1;
+    size_t block_begin = 0;
+    for (; block_begin + Block::kSize <= input.size(); block_begin += Block::kSize) {
+        const uint32_t separators = Block::SeparatorMask(data + block_begin);
+        // Bit i is set if data[i] and data[i - 1] differ in being a separator, i.e. a command starts or ends at i.
+        uint32_t edges = (separators ^ ((separators << 1) | previous_is_separator)) & kBlockMask;
+        previous_is_separator = (separators >> (Block::kSize - 1)) & 1;
+        while (edges != 0) {
+            const unsigned offset = __builtin_ctz(edges);
+            const size_t pos = block_begin + offset;
+            if ((separators >> offset) & 1) {
+                commands.emplace_back(data + command_begin, pos - command_begin);
+            } else {
+                command_begin = pos;
+            }
+            edges &= edges - 1;
+        }
+    }
+
+    bool in_command = !previous_is_separator;
+    for (size_t pos = block_begin; pos < input.size(); ++pos) {
+        const bool is_separator = IsCommandSeparator(data[pos]);
+        if (in_command && is_separator) {
+            commands.emplace_back(data + command_begin, pos - command_begin);
+        } else if (!in_command && !is_separator) {
+            command_begin = pos;
+        }
+        in_command = !is_separator;
+    }
+    if (in_command) {
+        commands.emplace_back(data + command_begin, input.size() - command_begin);
+    }
+    return commands;
+}
+
+__attribute__((target("sse2"))) std::vector<std::string_view> SplitCommandsSse2(std::string_view input) {
+    return SplitCommandsSimd<Sse2Block>(input);
+}
+
+__attribute__((target("avx2"))) std::vector<std::string_view> SplitCommandsAvx2(std::string_view input) {
+    return SplitCommandsSimd<Avx2Block>(input);
+}
+
+#endif
+
+}  // anonymous namespace
+
+bool IsTokenizerIsaSupported(TokenizerIsa isa) {
+    switch (isa) {
+        case TokenizerIsa::kScalar:
+            return true;
+#ifdef BULK_X86_TOKENIZER
+        case TokenizerIsa::kSse2:
+            return __builtin_cpu_supports("sse2");
+        case TokenizerIsa::kAvx2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+TokenizerIsa GetBestTokenizerIsa() {
+    static const TokenizerIsa best_isa = [] {
+        for (const auto isa : {TokenizerIsa::kAvx2, TokenizerIsa::kSse2}) {
+            if (IsTokenizerIsaSupported(isa)) {
+                return isa;
+            }
+        }
+        return TokenizerIsa::kScalar;
+    }();
+    return best_isa;
+}
+
+bool IsCommandSeparator(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+std::vector<std::string_view> SplitCommands(std::string_view input) {
+    return SplitCommands(input, GetBestTokenizerIsa());
+}
+
+std::vector<std::string_view> SplitCommands(std::string_view input, TokenizerIsa isa) {
+    assert(IsTokenizerIsaSupported(isa));
+    switch (isa) {
+#ifdef BULK_X86_TOKENIZER
+        case TokenizerIsa::kSse2:
+            return SplitCommandsSse2(input);
+        case TokenizerIsa::kAvx2:
+            return SplitCommandsAvx2(input);
+#endif
+        default:
+            return SplitCommandsScalar(input);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+enum class TokenizerIsa {
+    kScalar,
+    kSse2,
+    kAvx2,
+};
+
+// Returns true if the running CPU can execute the given tokenizer implementation.
+bool IsTokenizerIsaSupported(TokenizerIsa isa);
+
+// Returns the fastest tokenizer implementation supported by the running CPU.
+TokenizerIsa GetBestTokenizerIsa();
+
+// Returns true for the characters `std::istream >> std::string` treats as separators in the "C" locale.
+bool IsCommandSeparator(char c);
+
+// Splits input into commands the same way a sequence of `std::cin >> command` does.
+// Uses the implementation returned by GetBestTokenizerIsa.
+std::vector<std::string_view> SplitCommands(std::string_view input);
+
+// Same as above with an explicit implementation, which must be supported by the running CPU.
+std::vector<std::string_view> SplitCommands(std::string_view input, TokenizerIsa isa);